@@ -0,0 +1,687 @@
+// orderStatisticRedBlackTree.h : red black tree with ith order statistic, no platform dependencies
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// color of a node
+enum class Color { Red, Black };
+
+// number of buckets in the descent depth histogram, deeper descents are only counted in +Inf
+constexpr std::size_t DEPTH_BUCKETS = 64;
+
+// counters gathered by RBTree when instantiated with the RBTreeStats policy
+struct RBTreeStatsSnapshot {
+    std::uint64_t leftRotations = 0; // calls to LeftRotate
+    std::uint64_t rightRotations = 0; // calls to RightRotate
+    std::uint64_t fixupCase1 = 0; // RBInsert case 1, color flip of a node with two red children
+    std::uint64_t fixupCase2 = 0; // RBInsert case 2, red-red pair with inner grandchild
+    std::uint64_t fixupCase3 = 0; // RBInsert case 3, red-red pair with outer grandchild
+    std::uint64_t nodeAllocations = 0; // nodes created by RBInsert
+    std::array<std::uint64_t, DEPTH_BUCKETS> descentDepth{}; // histogram of descent depths
+    std::uint64_t descentDepthOverflow = 0; // descents of DEPTH_BUCKETS or more nodes
+    std::uint64_t descentDepthSum = 0; // sum of all recorded depths
+    int blackHeight = 0; // black height of the tree at the time of the snapshot
+
+    // export counters in Prometheus text exposition format
+    std::string ToPrometheus() const {
+        std::string out;
+        auto counter = [&out](const char* name, const char* help, std::uint64_t value) {
+            out += std::string("# HELP ") + name + " " + help + "\n";
+            out += std::string("# TYPE ") + name + " counter\n";
+            out += std::string(name) + " " + std::to_string(value) + "\n";
+        };
+        counter("rbtree_left_rotations_total", "Number of left rotations.", leftRotations);
+        counter("rbtree_right_rotations_total", "Number of right rotations.", rightRotations);
+        out += "# HELP rbtree_fixup_cases_total Number of insert fixup steps by case.\n";
+        out += "# TYPE rbtree_fixup_cases_total counter\n";
+        out += "rbtree_fixup_cases_total{case=\"1\"} " + std::to_string(fixupCase1) + "\n";
+        out += "rbtree_fixup_cases_total{case=\"2\"} " + std::to_string(fixupCase2) + "\n";
+        out += "rbtree_fixup_cases_total{case=\"3\"} " + std::to_string(fixupCase3) + "\n";
+        counter("rbtree_node_allocations_total", "Number of allocated nodes.", nodeAllocations);
+
+        // histogram buckets are cumulative, stop after the deepest non empty bucket
+        std::size_t last = 0;
+        for (std::size_t d = 0; d < DEPTH_BUCKETS; ++d) {
+            if (descentDepth[d] != 0) {
+                last = d;
+            }
+        }
+        out += "# HELP rbtree_descent_depth Number of nodes visited by a descent from the root.\n";
+        out += "# TYPE rbtree_descent_depth histogram\n";
+        std::uint64_t cumulative = 0;
+        for (std::size_t d = 0; d <= last; ++d) {
+            cumulative += descentDepth[d];
+            out += "rbtree_descent_depth_bucket{le=\"" + std::to_string(d) + "\"} " + std::to_string(cumulative) + "\n";
+        }
+        cumulative += descentDepthOverflow;
+        out += "rbtree_descent_depth_bucket{le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+        out += "rbtree_descent_depth_sum " + std::to_string(descentDepthSum) + "\n";
+        out += "rbtree_descent_depth_count " + std::to_string(cumulative) + "\n";
+
+        out += "# HELP rbtree_black_height Black height of the tree.\n";
+        out += "# TYPE rbtree_black_height gauge\n";
+        out += "rbtree_black_height " + std::to_string(blackHeight) + "\n";
+        return out;
+    }
+};
+
+// default stats policy, every hook is empty and compiles away
+struct NoStats {
+    static void LeftRotation() {}
+    static void RightRotation() {}
+    static void FixupCase1() {}
+    static void FixupCase2() {}
+    static void FixupCase3() {}
+    static void NodeAllocation() {}
+    static void Descent(std::size_t, std::uint64_t = 1) {}
+    static RBTreeStatsSnapshot Snapshot() { return {}; }
+    static void Reset() {}
+};
+
+// counters of one thread, aligned so that threads never write to the same cache line.
+// Only the owning thread increments them, relaxed atomics let other threads read them.
+// With a single writer an increment is a relaxed load and store, no locked read-modify-write.
+struct alignas(64) RBTreeStatsBlock {
+    std::atomic<std::uint64_t> leftRotations{ 0 };
+    std::atomic<std::uint64_t> rightRotations{ 0 };
+    std::atomic<std::uint64_t> fixupCase1{ 0 };
+    std::atomic<std::uint64_t> fixupCase2{ 0 };
+    std::atomic<std::uint64_t> fixupCase3{ 0 };
+    std::atomic<std::uint64_t> nodeAllocations{ 0 };
+    std::array<std::atomic<std::uint64_t>, DEPTH_BUCKETS> descentDepth{};
+    std::atomic<std::uint64_t> descentDepthOverflow{ 0 };
+    std::atomic<std::uint64_t> descentDepthSum{ 0 };
+
+    static void Add(std::atomic<std::uint64_t>& counter, std::uint64_t value = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // add counters of this block to snapshot
+    void AddTo(RBTreeStatsSnapshot& snapshot) const {
+        snapshot.leftRotations += leftRotations.load(std::memory_order_relaxed);
+        snapshot.rightRotations += rightRotations.load(std::memory_order_relaxed);
+        snapshot.fixupCase1 += fixupCase1.load(std::memory_order_relaxed);
+        snapshot.fixupCase2 += fixupCase2.load(std::memory_order_relaxed);
+        snapshot.fixupCase3 += fixupCase3.load(std::memory_order_relaxed);
+        snapshot.nodeAllocations += nodeAllocations.load(std::memory_order_relaxed);
+        for (std::size_t d = 0; d < DEPTH_BUCKETS; ++d) {
+            snapshot.descentDepth[d] += descentDepth[d].load(std::memory_order_relaxed);
+        }
+        snapshot.descentDepthOverflow += descentDepthOverflow.load(std::memory_order_relaxed);
+        snapshot.descentDepthSum += descentDepthSum.load(std::memory_order_relaxed);
+    }
+
+    void Clear() {
+        for (auto counter : { &leftRotations, &rightRotations, &fixupCase1, &fixupCase2, &fixupCase3,
+            &nodeAllocations, &descentDepthOverflow, &descentDepthSum }) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : descentDepth) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// stats policy counting into per-thread counter blocks. A hook costs a thread_local lookup and
+// a plain load and store on a cache line only its thread writes, so it never contends.
+// Every block is registered globally and Snapshot() sums all of them, so a metrics
+// thread sees the counts of all threads. Counts of finished threads are kept as well.
+// Counters are shared by all trees using this policy.
+struct RBTreeStats {
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<RBTreeStatsBlock*> live; // blocks of running threads
+        RBTreeStatsSnapshot retired; // counts of threads which already finished
+    };
+
+    // never destroyed, threads may still finish while static objects are destroyed
+    static Registry& GetRegistry() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    // block of one thread, registered for its whole lifetime
+    struct ThreadBlock {
+        RBTreeStatsBlock block;
+
+        ThreadBlock() {
+            auto& registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            registry.live.push_back(&block);
+        }
+
+        ~ThreadBlock() {
+            auto& registry = GetRegistry();
+            std::lock_guard lock(registry.mutex);
+            block.AddTo(registry.retired);
+            std::erase(registry.live, &block);
+        }
+    };
+
+    static RBTreeStatsBlock& Counters() {
+        thread_local ThreadBlock counters;
+        return counters.block;
+    }
+
+    static void LeftRotation() { RBTreeStatsBlock::Add(Counters().leftRotations); }
+    static void RightRotation() { RBTreeStatsBlock::Add(Counters().rightRotations); }
+    static void FixupCase1() { RBTreeStatsBlock::Add(Counters().fixupCase1); }
+    static void FixupCase2() { RBTreeStatsBlock::Add(Counters().fixupCase2); }
+    static void FixupCase3() { RBTreeStatsBlock::Add(Counters().fixupCase3); }
+    static void NodeAllocation() { RBTreeStatsBlock::Add(Counters().nodeAllocations); }
+
+    // times descents of depth nodes each
+    static void Descent(std::size_t depth, std::uint64_t times = 1) {
+        auto& counters = Counters();
+        RBTreeStatsBlock::Add(depth < DEPTH_BUCKETS ? counters.descentDepth[depth] : counters.descentDepthOverflow, times);
+        RBTreeStatsBlock::Add(counters.descentDepthSum, depth * times);
+    }
+
+    // sum of the counters of all threads
+    static RBTreeStatsSnapshot Snapshot() {
+        auto& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        auto snapshot = registry.retired;
+        for (auto block : registry.live) {
+            block->AddTo(snapshot);
+        }
+        return snapshot;
+    }
+
+    // zero the counters of all threads. A thread counting while the reset runs may write back
+    // its old value, so only reset while the trees are idle to get exact counts
+    static void Reset() {
+        auto& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        registry.retired = RBTreeStatsSnapshot{};
+        for (auto block : registry.live) {
+            block->Clear();
+        }
+    }
+};
+
+// define Comparable concept for values of type T to be compared to each other
+template<typename T>
+concept Comparable = requires(T a, T b) { a <=> b; };
+
+// default duplicate policy, every inserted key gets a node of its own
+struct SeparateDuplicates {
+    static constexpr bool counted = false;
+};
+
+// duplicate policy of a counted multiset, equal keys share one node which counts them.
+// Only allowed for strongly ordered keys, where equal keys cannot be told apart.
+struct CountDuplicates {
+    static constexpr bool counted = true;
+};
+
+// number of copies of the key of a node, only stored when duplicates are counted
+template<bool counted>
+struct NodeCount {
+    std::size_t count; // number of copies of key stored in Node
+};
+
+// without counting every node holds a single copy, the empty base takes no space
+template<>
+struct NodeCount<false> {
+};
+
+// definition of tree node
+template<typename T, typename Duplicates = SeparateDuplicates>
+requires Comparable<T>
+struct Node : NodeCount<Duplicates::counted> {
+    Node* left; //left child
+    Node* right;//right child
+    std::size_t size; // sum of counts in a subtree rooted at Node
+    T key; // key
+    ::Color color; // color of a node
+};
+
+// number of copies of key stored in node, always 1 unless duplicates are counted
+template<typename T, typename Duplicates>
+std::size_t CountOf(const Node<T, Duplicates>* node) {
+    if constexpr (Duplicates::counted) {
+        return node->count;
+    }
+    else {
+        return 1;
+    }
+}
+
+template<typename T, typename Stats = NoStats, typename Duplicates = SeparateDuplicates>
+requires Comparable<T> && (!Duplicates::counted || std::three_way_comparable<T, std::strong_ordering>)
+class RBTree { // class representing red black tree
+
+    Node<T, Duplicates>* root; // root of the tree
+    std::uint64_t version = 0; // incremented by every mutation
+
+    void TreeDestructorHelper(Node<T, Duplicates>* node) {
+        if (node->left != nullptr) {
+            TreeDestructorHelper(node->left);
+        }
+        if (node->right != nullptr) {
+            TreeDestructorHelper(node->right);
+        }
+        delete node;
+        node = nullptr;
+    }
+
+    static bool IsRed(Node<T, Duplicates>* node) {
+        return node != nullptr && node->color == ::Color::Red;
+    }
+
+    static std::size_t SizeOf(Node<T, Duplicates>* node) {
+        return node != nullptr ? node->size : 0;
+    }
+
+    // dynamically create red leaf holding a single copy of key
+    static Node<T, Duplicates>* NewNode(const T& key) {
+        Node<T, Duplicates>* z = new Node<T, Duplicates>;
+        Stats::NodeAllocation();
+        z->key = key;
+        z->right = nullptr;
+        z->left = nullptr;
+        z->color = ::Color::Red;
+        if constexpr (Duplicates::counted) {
+            z->count = 1;
+        }
+        z->size = 1;
+        return z;
+    }
+
+    // with CountDuplicates count one more copy in q if it holds key already, returns true if it did
+    static bool AddCopy(Node<T, Duplicates>* q, const T& key) {
+        if constexpr (Duplicates::counted) {
+            if (!(key < q->key) && !(q->key < key)) {
+                q->count++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // rotate subtree rooted at x to the left and return its new root
+    // caller has to link the returned node into x's former parent
+    Node<T, Duplicates>* LeftRotate(Node<T, Duplicates>* x) {
+        Stats::LeftRotation();
+        auto y = x->right;
+        x->right = y->left;
+        y->left = x;
+
+        // update size field
+        y->size = x->size;
+        x->size = SizeOf(x->left) + SizeOf(x->right) + CountOf(x);
+        return y;
+    }
+
+    // rotate subtree rooted at x to the right and return its new root
+    // caller has to link the returned node into x's former parent
+    Node<T, Duplicates>* RightRotate(Node<T, Duplicates>* x) {
+        Stats::RightRotation();
+        auto y = x->left;
+        x->left = y->right;
+        y->right = x;
+
+        //update size field
+        y->size = x->size;
+        x->size = SizeOf(x->left) + SizeOf(x->right) + CountOf(x);
+        return y;
+    }
+
+    // single rotation of g's red-red child pair, fixes the colors as well
+    Node<T, Duplicates>* SingleRotate(Node<T, Duplicates>* g, bool toLeft) {
+        auto top = toLeft ? LeftRotate(g) : RightRotate(g);
+        g->color = ::Color::Red;
+        top->color = ::Color::Black;
+        return top;
+    }
+
+    // double rotation, first rotate the inner grandchild above g's child
+    Node<T, Duplicates>* DoubleRotate(Node<T, Duplicates>* g, bool toLeft) {
+        if (toLeft) {
+            g->right = RightRotate(g->right);
+        }
+        else {
+            g->left = LeftRotate(g->left);
+        }
+        return SingleRotate(g, toLeft);
+    }
+
+    // node holding key (or nullptr) and the number of keys smaller than key,
+    // only used when duplicates are counted so that key is held by a single node
+    std::pair<Node<T, Duplicates>*, std::size_t> Find(const T& key) const {
+        std::size_t smaller = 0;
+        std::size_t depth = 0;
+        auto currentNode = root;
+        while (currentNode != nullptr) {
+            ++depth;
+            if (currentNode->key < key) {
+                smaller += SizeOf(currentNode->left) + CountOf(currentNode);
+                currentNode = currentNode->right;
+            }
+            else if (key < currentNode->key) {
+                currentNode = currentNode->left;
+            }
+            else {
+                smaller += SizeOf(currentNode->left);
+                break;
+            }
+        }
+        Stats::Descent(depth);
+        return { currentNode, smaller };
+    }
+
+    // number of keys smaller than key, or not greater than key if inclusive
+    std::size_t CountBelow(const T& key, bool inclusive) const {
+        std::size_t smaller = 0;
+        std::size_t depth = 0;
+        auto currentNode = root;
+        while (currentNode != nullptr) {
+            ++depth;
+            bool below = inclusive ? !(key < currentNode->key) : currentNode->key < key;
+            if (below) {
+                smaller += SizeOf(currentNode->left) + CountOf(currentNode);
+                currentNode = currentNode->right;
+            }
+            else {
+                currentNode = currentNode->left;
+            }
+        }
+        Stats::Descent(depth);
+        return smaller;
+    }
+
+    // every rank lies in the subtree of node, offset is the number of keys left of the subtree
+    // and depth the number of nodes from the root down to node
+    static void SelectHelper(const Node<T, Duplicates>* node, std::span<const std::size_t> ranks,
+        std::span<std::optional<T>> result, std::size_t offset, std::size_t depth) {
+        if (ranks.empty()) {
+            return;
+        }
+        if (node == nullptr) { // only reachable if size fields are inconsistent
+            std::fill(result.begin(), result.end(), std::nullopt);
+            return;
+        }
+        auto leftEnd = offset + SizeOf(node->left); // largest rank in the left subtree
+        auto nodeEnd = leftEnd + CountOf(node); // largest rank held by node
+        std::size_t l = std::upper_bound(ranks.begin(), ranks.end(), leftEnd) - ranks.begin();
+        std::size_t m = std::upper_bound(ranks.begin() + l, ranks.end(), nodeEnd) - ranks.begin();
+
+        std::fill(result.begin() + l, result.begin() + m, node->key);
+        if (m > l) {
+            Stats::Descent(depth, m - l); // each of these ranks took its own descent of depth nodes
+        }
+        SelectHelper(node->left, ranks.first(l), result.first(l), offset, depth + 1);
+        SelectHelper(node->right, ranks.subspan(m), result.subspan(m), nodeEnd, depth + 1);
+    }
+
+    // number of keys below each of the sorted keys, for all keys which lie in the subtree of node.
+    // offset is the number of keys left of the subtree and depth the number of nodes from the root down to node
+    static void CountBelowHelper(const Node<T, Duplicates>* node, std::span<const T> keys, std::span<std::size_t> result,
+        std::size_t offset, std::size_t depth, bool inclusive) {
+        if (keys.empty()) {
+            return;
+        }
+        if (node == nullptr) {
+            std::fill(result.begin(), result.end(), offset);
+            Stats::Descent(depth - 1, keys.size()); // each of these keys took its own descent of depth - 1 nodes
+            return;
+        }
+        // keys up to l continue left, the others are below node->key and continue right
+        std::size_t l = (inclusive ? std::lower_bound(keys.begin(), keys.end(), node->key)
+            : std::upper_bound(keys.begin(), keys.end(), node->key)) - keys.begin();
+        CountBelowHelper(node->left, keys.first(l), result.first(l), offset, depth + 1, inclusive);
+        CountBelowHelper(node->right, keys.subspan(l), result.subspan(l),
+            offset + SizeOf(node->left) + CountOf(node), depth + 1, inclusive);
+    }
+
+public:
+    RBTree() : root{ nullptr } { // construct empty tree
+    }
+
+    RBTree(T rootKey) : root{ NewNode(rootKey) } { // construct with the root
+        root->color = ::Color::Black;
+    }
+
+    ~RBTree() { // destructor
+        if (root != nullptr) {
+            TreeDestructorHelper(root);
+        }
+    }
+
+    auto GetRoot() {
+        return root;
+    }
+
+    const Node<T, Duplicates>* GetRoot() const {
+        return root;
+    }
+
+    // changes whenever the tree is modified, lets views cache derived data
+    std::uint64_t Version() const {
+        return version;
+    }
+
+    // number of black nodes on a path from the root down to a leaf
+    int BlackHeight() const {
+        int height = 0;
+        for (auto node = root; node != nullptr; node = node->left) {
+            if (node->color == ::Color::Black) {
+                ++height;
+            }
+        }
+        return height;
+    }
+
+    // counters summed over all threads, all zero unless Stats is RBTreeStats
+    RBTreeStatsSnapshot GetStats() const {
+        auto snapshot = Stats::Snapshot();
+        snapshot.blackHeight = BlackHeight();
+        return snapshot;
+    }
+
+    // top-down insertion, rebalances on the way down so a single pass is enough
+    // and no node needs to know its parent.
+    // Every node with two red children is recoloured (case 1), and a red-red
+    // pair created by that is rotated away at the grandparent (cases 2 and 3)
+    // before going further. Size of each node is incremented when it is
+    // entered. A rotation gives the new subtree root the old total and
+    // recomputes the nodes below it from their children; after a single
+    // rotation g is off the remaining path, after a double rotation p and g
+    // do not count the key yet and the one entered next is incremented then,
+    // so the counts stay exact.
+    // With CountDuplicates a key which is already present only increments
+    // count of its node, otherwise duplicates go to the right subtree.
+    void RBInsert(T key) {
+        ++version;
+        if (root == nullptr) {
+            root = NewNode(key);
+            root->color = ::Color::Black;
+            Stats::Descent(1);
+            return;
+        }
+
+        // g - grandparent, p - parent, q - current node
+        // gLink, pLink, qLink - child pointers (or root) pointing to them, a rotation at g
+        // stores the new subtree root through gLink, so the root needs no special case.
+        // After a rotation the links may be stale for two steps, no rotation can happen in those.
+        Node<T, Duplicates>* g = nullptr;
+        Node<T, Duplicates>* p = nullptr;
+        Node<T, Duplicates>* q = root;
+        Node<T, Duplicates>** gLink = nullptr;
+        Node<T, Duplicates>** pLink = nullptr;
+        Node<T, Duplicates>** qLink = &root;
+        bool dir = true; // direction from p to q, true is right
+        bool last = true; // direction from g to p
+        std::size_t depth = 0; // number of nodes from the root down to q
+
+        bool done = false;
+        while (!done) {
+            ++depth;
+            if (q == nullptr) { // reached a leaf, link new node
+                q = NewNode(key);
+                *qLink = q;
+                done = true;
+            }
+            else {
+                q->size++; // key ends up in the subtree of q
+                if (AddCopy(q, key)) { // duplicate, nothing to rebalance
+                    done = true;
+                }
+                else if (IsRed(q->left) && IsRed(q->right)) { // case 1 . color flip
+                    Stats::FixupCase1();
+                    q->color = ::Color::Red;
+                    q->left->color = ::Color::Black;
+                    q->right->color = ::Color::Black;
+                }
+            }
+
+            if (IsRed(q) && IsRed(p)) { // q and p are both red, rotate at g
+                Node<T, Duplicates>* top;
+                if (q == (last ? p->right : p->left)) { // case 3 . q is outer grandchild
+                    Stats::FixupCase3();
+                    top = SingleRotate(g, last);
+                    --depth; // p took the place of g, q is one level higher
+                }
+                else { // case 2 . q is inner grandchild, turn into case 3
+                    Stats::FixupCase2();
+                    Stats::FixupCase3();
+                    top = DoubleRotate(g, last);
+                    depth -= 2; // q took the place of g
+                }
+                *gLink = top;
+            }
+
+            if (done) {
+                break;
+            }
+
+            // go down the tree, same as in normal binary search tree
+            last = dir;
+            dir = !(key < q->key);
+            gLink = pLink;
+            pLink = qLink;
+            qLink = dir ? &q->right : &q->left;
+            g = p;
+            p = q;
+            q = *qLink;
+        }
+        Stats::Descent(depth);
+
+        root->color = ::Color::Black; // paint the root black
+    }
+
+    // i-th smallest key, 1 <= i <= size of the tree, otherwise std::nullopt
+    std::optional<T> getOrderStatistic(std::size_t i) const {
+        if (root == nullptr || i == 0 || i > root->size) { // check if i is in allowed range
+            return std::nullopt;
+        }
+        auto currentNode = root;
+        std::size_t depth = 0;
+
+        // loop down the tree from root until we find i-th smallest element
+        while (currentNode != nullptr) {
+            ++depth;
+            auto leftSize = SizeOf(currentNode->left);
+            bool goRight = i > leftSize;
+            if (goRight && i <= leftSize + CountOf(currentNode)) { // i falls on one of the copies in currentNode
+                Stats::Descent(depth);
+                return currentNode->key;
+            }
+            // go left if i is within the left subtree, otherwise go right
+            // and substract left subtree together with currentNode from i
+            i -= goRight ? leftSize + CountOf(currentNode) : 0;
+            currentNode = goRight ? currentNode->right : currentNode->left;
+        }
+        return std::nullopt; // only reachable if size fields are inconsistent
+    }
+
+    // order statistics of many ranks in a single traversal, ranks have to be sorted ascending.
+    // Nodes shared by the paths of several ranks are visited only once.
+    // result[j] is the ranks[j]-th smallest key, or std::nullopt if ranks[j] is out of range
+    void getOrderStatistics(std::span<const std::size_t> ranks, std::span<std::optional<T>> result) const {
+        assert(ranks.size() == result.size());
+        assert(std::is_sorted(ranks.begin(), ranks.end()));
+        std::size_t first = 0;
+        std::size_t last = ranks.size();
+        while (first < last && ranks[first] == 0) {
+            result[first++] = std::nullopt;
+        }
+        while (last > first && ranks[last - 1] > SizeOf(root)) {
+            result[--last] = std::nullopt;
+        }
+        SelectHelper(root, ranks.subspan(first, last - first), result.subspan(first, last - first), 0, 1);
+    }
+
+    // ranks of many keys in two traversals, keys have to be sorted ascending.
+    // Nodes shared by the paths of several keys are visited only once per traversal.
+    // result[j] is rank(keys[j])
+    void getRanks(std::span<const T> keys, std::span<std::optional<std::size_t>> result) const {
+        assert(keys.size() == result.size());
+        assert(std::is_sorted(keys.begin(), keys.end()));
+        std::vector<std::size_t> smaller(keys.size());
+        std::vector<std::size_t> notGreater(keys.size());
+        CountBelowHelper(root, keys, smaller, 0, 1, false);
+        CountBelowHelper(root, keys, notGreater, 0, 1, true);
+        for (std::size_t j = 0; j < keys.size(); ++j) {
+            result[j] = notGreater[j] != smaller[j] ? std::optional<std::size_t>(smaller[j] + 1) : std::nullopt;
+        }
+    }
+
+    // number of copies of many keys in two traversals, keys have to be sorted ascending.
+    // result[j] is Count(keys[j])
+    void getCounts(std::span<const T> keys, std::span<std::size_t> result) const {
+        assert(keys.size() == result.size());
+        assert(std::is_sorted(keys.begin(), keys.end()));
+        std::vector<std::size_t> smaller(keys.size());
+        CountBelowHelper(root, keys, smaller, 0, 1, false);
+        CountBelowHelper(root, keys, result, 0, 1, true);
+        for (std::size_t j = 0; j < keys.size(); ++j) {
+            result[j] -= smaller[j];
+        }
+    }
+
+    // rank of the first occurrence of key (1 for the smallest key), std::nullopt if key is absent
+    std::optional<std::size_t> rank(const T& key) const {
+        if constexpr (Duplicates::counted) {
+            auto node = Find(key);
+            if (node.first == nullptr) {
+                return std::nullopt;
+            }
+            return node.second + 1;
+        }
+        else {
+            auto smaller = CountBelow(key, false);
+            if (CountBelow(key, true) == smaller) {
+                return std::nullopt;
+            }
+            return smaller + 1;
+        }
+    }
+
+    // number of copies of key in the tree
+    std::size_t Count(const T& key) const {
+        if constexpr (Duplicates::counted) {
+            auto node = Find(key);
+            return node.first != nullptr ? CountOf(node.first) : 0;
+        }
+        else {
+            return CountBelow(key, true) - CountBelow(key, false);
+        }
+    }
+};
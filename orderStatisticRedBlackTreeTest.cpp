@@ -0,0 +1,506 @@
+// orderStatisticRedBlackTreeTest.cpp : invariant checker and randomized test of RBTree
+//
+// Build:  g++ -std=c++20 -O1 -g -fsanitize=address,undefined orderStatisticRedBlackTreeTest.cpp -o rbTreeTest
+// Run:    rbTreeTest [seeds]      exits with 1 and prints the first violation on failure
+
+#include "orderStatisticRedBlackTree.h"
+#include "treeLayout.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <latch>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// only counted trees pay for the count of a node
+static_assert(sizeof(Node<int>) + sizeof(std::size_t) == sizeof(Node<int, CountDuplicates>));
+
+bool failed = false;
+
+void Fail(const std::string& message) {
+    if (!failed) {
+        std::printf("FAILED: %s\n", message.c_str());
+    }
+    failed = true;
+}
+
+// checks colors, black height, order of keys and size fields of the subtree rooted at node,
+// returns its black height counting the nil leaves
+template<typename T, typename Duplicates>
+int CheckSubtree(const Node<T, Duplicates>* node, const T* low, const T* high, std::size_t& nodes) {
+    if (node == nullptr) {
+        return 1;
+    }
+    ++nodes;
+    if (node->color == ::Color::Red) {
+        if ((node->left != nullptr && node->left->color == ::Color::Red)
+            || (node->right != nullptr && node->right->color == ::Color::Red)) {
+            Fail("red node with a red child");
+        }
+    }
+    // duplicates may end up on both sides after rotations, so bounds are inclusive
+    if ((low != nullptr && node->key < *low) || (high != nullptr && *high < node->key)) {
+        Fail("key out of order");
+    }
+    if (CountOf(node) == 0) {
+        Fail("wrong count of a node");
+    }
+    auto leftSize = node->left != nullptr ? node->left->size : 0;
+    auto rightSize = node->right != nullptr ? node->right->size : 0;
+    if (node->size != leftSize + rightSize + CountOf(node)) {
+        Fail("size is not the sum of counts in the subtree");
+    }
+
+    int leftHeight = CheckSubtree(node->left, low, &node->key, nodes);
+    int rightHeight = CheckSubtree(node->right, &node->key, high, nodes);
+    if (leftHeight != rightHeight) {
+        Fail("black height differs between subtrees");
+    }
+    return leftHeight + (node->color == ::Color::Black ? 1 : 0);
+}
+
+// checks all red black tree invariants, returns the number of nodes
+template<typename T, typename Stats, typename Duplicates>
+std::size_t CheckInvariants(const RBTree<T, Stats, Duplicates>& tree) {
+    std::size_t nodes = 0;
+    auto root = tree.GetRoot();
+    if (root != nullptr && root->color != ::Color::Black) {
+        Fail("root is not black");
+    }
+    CheckSubtree<T, Duplicates>(root, nullptr, nullptr, nodes);
+    return nodes;
+}
+
+// compares select, rank and count of tree, single and batched, with a std::multiset
+template<typename T, typename Stats, typename Duplicates>
+void CheckQueries(const RBTree<T, Stats, Duplicates>& tree, const std::multiset<T>& reference, T lowKey, T highKey) {
+    std::vector<T> sorted(reference.begin(), reference.end());
+    auto size = sorted.size();
+
+    std::vector<std::size_t> ranks;
+    for (std::size_t i = 0; i <= size + 1; ++i) {
+        auto expected = i >= 1 && i <= size ? std::optional<T>(sorted[i - 1]) : std::nullopt;
+        if (tree.getOrderStatistic(i) != expected) {
+            Fail("getOrderStatistic(" + std::to_string(i) + ")");
+        }
+        ranks.push_back(i);
+    }
+
+    std::vector<std::optional<T>> batch(ranks.size());
+    tree.getOrderStatistics(ranks, batch);
+    for (std::size_t i = 0; i < ranks.size(); ++i) {
+        if (batch[i] != tree.getOrderStatistic(ranks[i])) {
+            Fail("getOrderStatistics differs at rank " + std::to_string(ranks[i]));
+        }
+    }
+
+    std::vector<T> keys;
+    for (auto key = lowKey; key <= highKey; ++key) {
+        keys.push_back(key);
+        auto first = reference.lower_bound(key);
+        auto expected = first != reference.end() && *first == key
+            ? std::optional<std::size_t>(std::distance(reference.begin(), first) + 1) : std::nullopt;
+        if (tree.rank(key) != expected) {
+            Fail("rank(" + std::to_string(key) + ")");
+        }
+        if (tree.Count(key) != reference.count(key)) {
+            Fail("Count(" + std::to_string(key) + ")");
+        }
+    }
+
+    std::vector<std::optional<std::size_t>> batchRanks(keys.size());
+    std::vector<std::size_t> batchCounts(keys.size());
+    tree.getRanks(keys, batchRanks);
+    tree.getCounts(keys, batchCounts);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (batchRanks[i] != tree.rank(keys[i])) {
+            Fail("getRanks differs at key " + std::to_string(keys[i]));
+        }
+        if (batchCounts[i] != tree.Count(keys[i])) {
+            Fail("getCounts differs at key " + std::to_string(keys[i]));
+        }
+    }
+}
+
+template<typename Tree>
+struct CountedTree : std::false_type {};
+
+template<typename T, typename Stats>
+struct CountedTree<RBTree<T, Stats, CountDuplicates>> : std::true_type {};
+
+// inserts random keys of one distribution into a tree, checking invariants as it grows
+template<typename Tree>
+void RunSeed(unsigned seed) {
+    std::mt19937 random(seed);
+    int keyRange = seed % 4 == 0 ? 8 : seed % 4 == 1 ? 200 : 1 << 30; // many, some and hardly any duplicates
+    int inserts = 1500;
+
+    Tree tree;
+    std::multiset<int> reference;
+    for (int i = 0; i < inserts && !failed; ++i) {
+        int key;
+        switch (seed % 3) {
+        case 0: key = i; break; // ascending
+        case 1: key = inserts - i; break; // descending
+        default: key = static_cast<int>(random() % keyRange); break;
+        }
+        tree.RBInsert(key);
+        reference.insert(key);
+
+        if (i % 97 == 0 || i == inserts - 1) {
+            auto nodes = CheckInvariants(tree);
+            auto root = tree.GetRoot();
+            if (root == nullptr || root->size != reference.size()) {
+                Fail("root size differs from number of inserted keys");
+            }
+            // counted trees hold one node per distinct key, others one per insert
+            std::size_t distinct = std::distance(reference.begin(), reference.end());
+            if (CountedTree<Tree>::value) {
+                distinct = 0;
+                for (auto it = reference.begin(); it != reference.end(); it = reference.upper_bound(*it)) {
+                    ++distinct;
+                }
+            }
+            if (nodes != distinct) {
+                Fail("unexpected number of nodes");
+            }
+        }
+    }
+    if (failed) { // queries on a broken tree may not terminate
+        return;
+    }
+    int low = *reference.begin() - 1;
+    int high = seed % 3 == 2 && keyRange > 1000 ? low + 50 : *reference.rbegin() + 1;
+    CheckQueries(tree, reference, low, high);
+}
+
+// number of nodes on the longest path from node down to a leaf
+template<typename T, typename Duplicates>
+std::size_t Height(const Node<T, Duplicates>* node) {
+    return node == nullptr ? 0 : 1 + (std::max)(Height(node->left), Height(node->right));
+}
+
+template<typename T, typename Duplicates>
+void InOrder(const Node<T, Duplicates>* node, std::vector<const Node<T, Duplicates>*>& nodes) {
+    if (node != nullptr) {
+        InOrder(node->left, nodes);
+        nodes.push_back(node);
+        InOrder(node->right, nodes);
+    }
+}
+
+// indexes of the nodes written by ExportDot, and the key counts of its collapsed subtrees by index
+void ParseDot(const std::string& dot, std::set<std::size_t>& written, std::vector<std::pair<std::size_t, std::size_t>>& boxes) {
+    std::istringstream lines(dot);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.rfind("  n", 0) == 0 && line.find(" [label=") != std::string::npos) {
+            written.insert(std::stoul(line.substr(3)));
+        }
+        else if (line.rfind("  c", 0) == 0 && line.find("shape=box") != std::string::npos) {
+            auto label = line.find("label=\"");
+            boxes.emplace_back(std::stoul(line.substr(3)), std::stoul(line.substr(label + 7)));
+        }
+    }
+}
+
+// in-order x of the nodes drawn by ExportSvg, nodeSpacing has to be 40
+std::set<std::size_t> ParseSvg(const std::string& svg) {
+    std::set<std::size_t> drawn;
+    for (auto at = svg.find("<circle cx=\""); at != std::string::npos; at = svg.find("<circle cx=\"", at + 1)) {
+        drawn.insert(static_cast<std::size_t>(std::stod(svg.substr(at + 12)) / 40));
+    }
+    return drawn;
+}
+
+// checks positions and nesting of the layout of tree, and the culling and collapsing of its exports
+template<typename Duplicates>
+void CheckLayout(unsigned seed) {
+    std::mt19937 random(seed);
+    RBTree<int, NoStats, Duplicates> tree;
+    TreeLayout<int, Duplicates> layout;
+    if (!layout.Update(tree) || layout.Update(tree) || layout.Width() != 0) {
+        Fail("layout of the empty tree");
+    }
+    for (int i = 0; i < 300; ++i) {
+        tree.RBInsert(static_cast<int>(random() % 100));
+    }
+    if (!layout.Update(tree) || layout.Update(tree)) {
+        Fail("Update has to recompute exactly when the tree changed");
+    }
+    tree.RBInsert(7);
+    if (!layout.Update(tree) || layout.Update(tree)) {
+        Fail("Update after RBInsert");
+    }
+
+    std::vector<const Node<int, Duplicates>*> inOrder;
+    InOrder(tree.GetRoot(), inOrder);
+    const auto& nodes = layout.Nodes();
+    if (nodes.size() != inOrder.size() || layout.Width() != inOrder.size() || layout.Height() != Height(tree.GetRoot())) {
+        Fail("size of the layout");
+        return;
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const auto& n = nodes[i];
+        if (n.x >= inOrder.size() || inOrder[n.x] != n.node) {
+            Fail("x is not the in-order index");
+        }
+        if (n.firstX > n.x || n.x > n.lastX || n.subtreeEnd <= i || n.subtreeEnd > nodes.size()
+            || n.subtreeEnd - i != n.lastX - n.firstX + 1) {
+            Fail("range of a subtree");
+        }
+        if (n.parent == NO_PARENT ? i != 0 || n.depth != 0 : n.parent >= i || n.depth != nodes[n.parent].depth + 1) {
+            Fail("parent of a node");
+            continue;
+        }
+        // the subtree of a node lies within the subtree of its parent, and holds exactly the nodes after it
+        for (auto j = i + 1; j < n.subtreeEnd; ++j) {
+            if (nodes[j].parent < i || nodes[j].parent >= j || nodes[j].x < n.firstX || nodes[j].x > n.lastX) {
+                Fail("subtree is not nested");
+                break;
+            }
+        }
+        if (n.parent != NO_PARENT) {
+            const auto& p = nodes[n.parent];
+            if (n.firstX < p.firstX || n.lastX > p.lastX || n.subtreeEnd > p.subtreeEnd) {
+                Fail("subtree exceeds the subtree of its parent");
+            }
+        }
+    }
+
+    if (failed) { // exports of a broken layout may not terminate
+        return;
+    }
+
+    // a node is written if its subtree reaches into [first, last] and it is not below maxDepth
+    auto first = static_cast<std::size_t>(random() % nodes.size());
+    auto last = first + static_cast<std::size_t>(random() % 20);
+    auto expected = [&](std::size_t maxDepth) {
+        std::set<std::size_t> visible;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].lastX >= first && nodes[i].firstX <= last && nodes[i].depth <= maxDepth) {
+                visible.insert(i);
+            }
+        }
+        return visible;
+    };
+    for (std::size_t maxDepth : { std::size_t{ 64 }, std::size_t{ 3 } }) {
+        std::ostringstream dot;
+        DotOptions dotOptions;
+        dotOptions.maxDepth = maxDepth;
+        dotOptions.firstX = first;
+        dotOptions.lastX = last;
+        ExportDot(dot, layout, dotOptions);
+        std::set<std::size_t> written;
+        std::vector<std::pair<std::size_t, std::size_t>> boxes;
+        ParseDot(dot.str(), written, boxes);
+        auto visible = expected(maxDepth);
+        if (written != visible) {
+            Fail("ExportDot culling");
+        }
+        std::size_t collapsed = 0;
+        for (auto i : visible) {
+            collapsed += nodes[i].depth == maxDepth && nodes[i].subtreeEnd > i + 1 ? 1 : 0;
+        }
+        if (boxes.size() != collapsed) {
+            Fail("ExportDot collapsed subtrees");
+        }
+        for (auto [i, keys] : boxes) {
+            std::size_t below = 0;
+            for (auto j = i + 1; j < nodes[i].subtreeEnd; ++j) {
+                below += CountOf(nodes[j].node);
+            }
+            if (keys != below) {
+                Fail("ExportDot keys of a collapsed subtree");
+            }
+        }
+
+        // viewport covering exactly x from first to last and the levels down to maxDepth
+        SvgOptions svgOptions;
+        svgOptions.nodeSpacing = 40;
+        svgOptions.levelHeight = 80;
+        svgOptions.radius = 15;
+        svgOptions.viewLeft = static_cast<double>(first) * 40;
+        svgOptions.viewWidth = static_cast<double>(last - first + 1) * 40;
+        svgOptions.viewHeight = static_cast<double>((std::min)(maxDepth, std::size_t{ 4 }) + 1) * 80;
+        std::ostringstream svg;
+        ExportSvg(svg, layout, svgOptions);
+        std::set<std::size_t> drawn;
+        for (auto i : expected((std::min)(maxDepth, std::size_t{ 4 }))) {
+            drawn.insert(nodes[i].x);
+        }
+        if (ParseSvg(svg.str()) != drawn) {
+            Fail("ExportSvg culling");
+        }
+    }
+}
+
+// a snapshot line of ToPrometheus(), name including its labels
+bool HasMetric(const RBTreeStatsSnapshot& stats, const std::string& name, std::uint64_t value) {
+    auto text = "\n" + stats.ToPrometheus();
+    return text.find("\n" + name + " " + std::to_string(value) + "\n") != std::string::npos;
+}
+
+// number of nodes from the root down to the node holding key, keys have to be distinct
+template<typename T, typename Stats, typename Duplicates>
+std::size_t DepthOf(const RBTree<T, Stats, Duplicates>& tree, const T& key) {
+    std::size_t depth = 0;
+    for (auto node = tree.GetRoot(); node != nullptr; node = key < node->key ? node->left : node->right) {
+        ++depth;
+        if (!(key < node->key) && !(node->key < key)) {
+            return depth;
+        }
+    }
+    return 0;
+}
+
+// the depth recorded for every insert has to be the depth the new node ends up at,
+// so the deepest recorded insert is at most the largest height the tree had
+void CheckInsertDepths(const std::vector<int>& keys) {
+    RBTree<int, RBTreeStats> tree;
+    std::size_t deepest = 0;
+    std::size_t highest = 0;
+    for (auto key : keys) {
+        RBTreeStats::Reset();
+        tree.RBInsert(key);
+        auto stats = RBTreeStats::Snapshot();
+        auto depth = DepthOf(tree, key);
+        if (stats.descentDepthSum != depth || stats.descentDepth[depth] != 1) {
+            Fail("recorded insert depth of key " + std::to_string(key));
+            return;
+        }
+        deepest = (std::max)(deepest, depth);
+        highest = (std::max)(highest, Height(tree.GetRoot()));
+    }
+    if (deepest > highest) {
+        Fail("recorded insert depth exceeds the height of the tree");
+    }
+}
+
+// ascending keys, so that every insert after the second one rotates
+void InsertAscending(int keys) {
+    RBTree<int, RBTreeStats> tree;
+    for (int key = 1; key <= keys; ++key) {
+        tree.RBInsert(key);
+    }
+}
+
+// checks the counters of the RBTreeStats policy, their aggregation over threads and their export
+void CheckStats() {
+    RBTreeStats::Reset();
+    {
+        RBTree<int, RBTreeStats> tree;
+        for (int key : { 1, 2, 3 }) {
+            tree.RBInsert(key);
+        }
+        auto stats = tree.GetStats();
+        if (stats.leftRotations != 1 || stats.rightRotations != 0 || stats.fixupCase1 != 0
+            || stats.fixupCase2 != 0 || stats.fixupCase3 != 1 || stats.nodeAllocations != 3) {
+            Fail("counters of inserting 1, 2, 3");
+        }
+        if (!HasMetric(stats, "rbtree_left_rotations_total", 1) || !HasMetric(stats, "rbtree_fixup_cases_total{case=\"3\"}", 1)
+            || !HasMetric(stats, "rbtree_node_allocations_total", 3) || !HasMetric(stats, "rbtree_black_height", 1)
+            || !HasMetric(stats, "rbtree_descent_depth_count", 3)) {
+            Fail("ToPrometheus of inserting 1, 2, 3");
+        }
+    }
+
+    // descents of DEPTH_BUCKETS or more nodes only go to +Inf
+    RBTreeStats::Reset();
+    RBTreeStats::Descent(2);
+    RBTreeStats::Descent(DEPTH_BUCKETS);
+    RBTreeStats::Descent(DEPTH_BUCKETS * 10, 2);
+    auto stats = RBTreeStats::Snapshot();
+    std::uint64_t inBuckets = 0;
+    for (auto count : stats.descentDepth) {
+        inBuckets += count;
+    }
+    if (inBuckets != 1 || stats.descentDepth[2] != 1 || stats.descentDepthOverflow != 3
+        || stats.descentDepthSum != 2 + DEPTH_BUCKETS * 21) {
+        Fail("descent depth overflow");
+    }
+    if (!HasMetric(stats, "rbtree_descent_depth_bucket{le=\"2\"}", 1) || !HasMetric(stats, "rbtree_descent_depth_bucket{le=\"+Inf\"}", 4)
+        || !HasMetric(stats, "rbtree_descent_depth_count", 4)
+        || stats.ToPrometheus().find("le=\"3\"") != std::string::npos) {
+        Fail("ToPrometheus of descent depth overflow");
+    }
+
+    std::vector<int> distinct(1000);
+    for (int i = 0; i < 1000; ++i) {
+        distinct[i] = i + 1;
+    }
+    CheckInsertDepths(distinct);
+    std::shuffle(distinct.begin(), distinct.end(), std::mt19937(1));
+    CheckInsertDepths(distinct);
+
+    // counts of running and finished threads are summed into every snapshot
+    constexpr int keys = 300;
+    constexpr int threads = 4;
+    RBTreeStats::Reset();
+    InsertAscending(keys);
+    auto single = RBTreeStats::Snapshot();
+    RBTreeStats::Reset();
+
+    std::latch inserted(threads);
+    std::latch finish(1);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            InsertAscending(keys);
+            inserted.count_down();
+            finish.wait();
+        });
+    }
+    inserted.wait();
+    auto running = RBTreeStats::Snapshot();
+    finish.count_down();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto finished = RBTreeStats::Snapshot();
+
+    auto sameAsThreads = [&](const RBTreeStatsSnapshot& total) {
+        return total.leftRotations == threads * single.leftRotations && total.nodeAllocations == threads * single.nodeAllocations
+            && total.fixupCase1 == threads * single.fixupCase1 && total.descentDepthSum == threads * single.descentDepthSum;
+    };
+    if (!sameAsThreads(running)) {
+        Fail("stats of running threads");
+    }
+    if (!sameAsThreads(finished)) {
+        Fail("stats of finished threads");
+    }
+    RBTreeStats::Reset();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned seeds = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 60;
+
+    for (unsigned seed = 0; seed < seeds && !failed; ++seed) {
+        RunSeed<RBTree<int>>(seed);
+        RunSeed<RBTree<int, RBTreeStats>>(seed);
+        RunSeed<RBTree<int, NoStats, CountDuplicates>>(seed);
+        CheckLayout<SeparateDuplicates>(seed);
+        CheckLayout<CountDuplicates>(seed);
+        if (failed) {
+            std::printf("seed %u\n", seed);
+        }
+    }
+    CheckStats();
+    if (failed) {
+        return 1;
+    }
+    std::printf("passed %u seeds\n", seeds);
+    return 0;
+}
@@ -0,0 +1,527 @@
+// rankServer.cpp : local query server for RBTree (Linux only)
+//
+// Build:  g++ -std=c++20 -O2 rankServer.cpp -o rankServer
+// Run:    rankServer [socket path | tcp port]      default is /tmp/rbtree.sock
+//
+// Protocol is line based, every request gets exactly one response line, in order:
+//   INSERT <key>   ->  OK
+//   RANK <key>     ->  rank of the first occurrence of key, or NONE
+//   SELECT <i>     ->  i-th smallest key, or NONE
+//   COUNT <key>    ->  number of copies of key
+// anything else is answered with ERR.
+//
+// A single thread runs an epoll loop and every connection is served by a coroutine.
+// Requests which arrive during one turn of the loop are handled together as a batch.
+// The batch is split into rounds, a connection moves on to the next round with the first
+// INSERT it sends after a query. Each round applies its inserts first (group commit), then
+// answers its SELECTs, RANKs and COUNTs, each kind sorted and answered by one multi-key
+// traversal of the tree. So a query sees every insert its connection sent before it and
+// none sent after it. Responses are sent after the whole batch is done, so an
+// acknowledged insert is visible to every later request.
+//
+// A connection is not read while more than MAX_OUTPUT bytes of its responses are unsent,
+// so a client which does not read its responses cannot grow the server's memory.
+// When accept runs out of file descriptors the listener is not watched until a
+// connection closes or ACCEPT_RETRY_MS passed.
+
+#include "orderStatisticRedBlackTree.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Key = long long;
+
+// requests longer than this without a newline close the connection
+constexpr std::size_t MAX_LINE = 4096;
+
+// input of a connection is paused while more unsent responses than this are queued
+constexpr std::size_t MAX_OUTPUT = 1 << 20;
+
+// milliseconds to wait before accepting again after running out of file descriptors
+constexpr int ACCEPT_RETRY_MS = 100;
+
+// maximum number of epoll events handled in one turn of the loop
+constexpr int MAX_EVENTS = 256;
+
+// coroutine which starts running immediately and is destroyed by its owner
+struct Task {
+    struct promise_type {
+        Task get_return_object() {
+            return Task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> h = nullptr) : handle{ h } {}
+    Task(Task&& other) noexcept : handle{ std::exchange(other.handle, nullptr) } {}
+    Task& operator=(Task&& other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+};
+
+// file descriptor registered in epoll together with the coroutine waiting for it
+struct Channel {
+    int fd = -1;
+    std::coroutine_handle<> reader; // resumed when fd becomes readable
+};
+
+// awaitable suspending the coroutine until the channel is readable
+struct Readable {
+    Channel& channel;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept { channel.reader = h; }
+    void await_resume() const noexcept {}
+};
+
+struct Connection : Channel {
+    std::string in; // received bytes not yet parsed
+    std::string out; // responses not yet sent
+    bool readDone = false; // peer shut down its side, remaining responses are still sent
+    bool closed = false; // connection is dropped at the end of the turn
+    std::uint32_t events = EPOLLIN; // events the connection is registered for
+    std::size_t round = 0; // round of the current batch the last request belongs to
+    bool queried = false; // a query was sent in that round
+    Task task;
+
+    ~Connection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+enum class Op { Insert, Rank, Select, Count, Invalid };
+
+// one parsed request waiting for the end of the batch
+struct Request {
+    Connection* connection;
+    Op op;
+    Key key; // key of INSERT, RANK and COUNT
+    std::size_t rank; // i of SELECT
+    std::size_t round; // requests are processed round by round
+    std::string response;
+};
+
+class RankServer {
+
+    RBTree<Key, NoStats, CountDuplicates> tree;
+    int epollFd = -1;
+    Channel listener;
+    Task acceptTask;
+    bool acceptPaused = false; // listener is not watched after accept ran out of resources
+    std::chrono::steady_clock::time_point acceptRetry; // watch the listener again at the latest then
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<Request> batch;
+
+    static bool SetNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    bool Watch(Channel& channel, std::uint32_t events, int operation) {
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = &channel;
+        return epoll_ctl(epollFd, operation, channel.fd, &event) == 0;
+    }
+
+    static Request Parse(Connection& connection, std::string_view line) {
+        Request request{ &connection, Op::Invalid, 0, 0, 0, {} };
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        auto space = line.find(' ');
+        if (space == std::string_view::npos) {
+            return request;
+        }
+        auto name = line.substr(0, space);
+        auto argument = line.substr(space + 1);
+        auto begin = argument.data();
+        auto end = argument.data() + argument.size();
+
+        if (name == "SELECT") {
+            auto [ptr, error] = std::from_chars(begin, end, request.rank);
+            if (error == std::errc{} && ptr == end) {
+                request.op = Op::Select;
+            }
+            return request;
+        }
+        auto [ptr, error] = std::from_chars(begin, end, request.key);
+        if (error != std::errc{} || ptr != end) {
+            return request;
+        }
+        if (name == "INSERT") {
+            request.op = Op::Insert;
+        }
+        else if (name == "RANK") {
+            request.op = Op::Rank;
+        }
+        else if (name == "COUNT") {
+            request.op = Op::Count;
+        }
+        return request;
+    }
+
+    // accept new connections and start a coroutine for each of them
+    Task AcceptLoop() {
+        for (;;) {
+            co_await Readable{ listener };
+            for (;;) {
+                int fd = accept(listener.fd, nullptr, nullptr);
+                if (fd < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        break; // nothing more to accept
+                    }
+                    if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+                        continue; // only this connection failed
+                    }
+                    // EMFILE, ENFILE, ENOBUFS or ENOMEM: the pending connection stays queued and
+                    // the listener stays readable, so stop watching it instead of spinning
+                    PauseAccept();
+                    break;
+                }
+                auto connection = std::make_unique<Connection>();
+                connection->fd = fd;
+                if (!SetNonBlocking(fd) || !Watch(*connection, EPOLLIN, EPOLL_CTL_ADD)) {
+                    continue; // connection closes fd
+                }
+                connection->task = Serve(*connection);
+                connections.push_back(std::move(connection));
+            }
+        }
+    }
+
+    void PauseAccept() {
+        acceptPaused = true;
+        acceptRetry = std::chrono::steady_clock::now() + std::chrono::milliseconds(ACCEPT_RETRY_MS);
+        Watch(listener, 0, EPOLL_CTL_MOD);
+    }
+
+    void ResumeAccept() {
+        acceptPaused = false;
+        Watch(listener, EPOLLIN, EPOLL_CTL_MOD);
+    }
+
+    // read requests of one connection and add them to the current batch
+    Task Serve(Connection& connection) {
+        char buffer[4096];
+        for (;;) {
+            co_await Readable{ connection };
+            auto n = read(connection.fd, buffer, sizeof buffer);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            if (n == 0) { // peer is done sending, stop polling for input
+                connection.readDone = true;
+                UpdateEvents(connection);
+                co_return;
+            }
+            if (n < 0) {
+                connection.closed = true;
+                co_return;
+            }
+            connection.in.append(buffer, static_cast<std::size_t>(n));
+
+            std::size_t start = 0;
+            for (auto newline = connection.in.find('\n'); newline != std::string::npos;
+                newline = connection.in.find('\n', start)) {
+                batch.push_back(Parse(connection, std::string_view(connection.in).substr(start, newline - start)));
+                start = newline + 1;
+            }
+            connection.in.erase(0, start);
+            if (connection.in.size() > MAX_LINE) {
+                connection.closed = true;
+                co_return;
+            }
+        }
+    }
+
+    static std::string Format(std::size_t answer) {
+        return std::to_string(answer);
+    }
+
+    template<typename Answer>
+    static std::string Format(const std::optional<Answer>& answer) {
+        return answer ? std::to_string(*answer) : "NONE";
+    }
+
+    // sort queries by their argument, answer all of them with one call of the batched tree query
+    // and store the responses, queries hold the argument and the index of the request in the batch
+    template<typename Answer, typename Argument, typename Batched>
+    void AnswerSorted(std::vector<std::pair<Argument, std::size_t>>& queries, Batched batched) {
+        if (queries.empty()) {
+            return;
+        }
+        std::sort(queries.begin(), queries.end());
+        std::vector<Argument> arguments(queries.size());
+        std::vector<Answer> answers(queries.size());
+        for (std::size_t j = 0; j < queries.size(); ++j) {
+            arguments[j] = queries[j].first;
+        }
+        batched(std::span<const Argument>(arguments), std::span<Answer>(answers));
+        for (std::size_t j = 0; j < queries.size(); ++j) {
+            batch[queries[j].second].response = Format(answers[j]);
+        }
+    }
+
+    // answer the requests of one round, given by their indexes in the batch
+    void ProcessRound(std::span<const std::size_t> round) {
+        // group commit, every insert of the round is applied before any query
+        for (auto i : round) {
+            if (batch[i].op == Op::Insert) {
+                tree.RBInsert(batch[i].key);
+                batch[i].response = "OK";
+            }
+        }
+
+        std::vector<std::pair<std::size_t, std::size_t>> selects; // rank, index in batch
+        std::vector<std::pair<Key, std::size_t>> ranks; // key, index in batch
+        std::vector<std::pair<Key, std::size_t>> counts; // key, index in batch
+        for (auto i : round) {
+            switch (batch[i].op) {
+            case Op::Select: selects.emplace_back(batch[i].rank, i); break;
+            case Op::Rank: ranks.emplace_back(batch[i].key, i); break;
+            case Op::Count: counts.emplace_back(batch[i].key, i); break;
+            case Op::Invalid: batch[i].response = "ERR"; break;
+            case Op::Insert: break;
+            }
+        }
+        AnswerSorted<std::optional<Key>>(selects, [this](auto arguments, auto answers) {
+            tree.getOrderStatistics(arguments, answers);
+        });
+        AnswerSorted<std::optional<std::size_t>>(ranks, [this](auto arguments, auto answers) {
+            tree.getRanks(arguments, answers);
+        });
+        AnswerSorted<std::size_t>(counts, [this](auto arguments, auto answers) {
+            tree.getCounts(arguments, answers);
+        });
+    }
+
+    // answer all requests of the batch
+    void ProcessBatch() {
+        // a connection enters the next round with an insert following one of its queries,
+        // so that its queries never see inserts it sent after them
+        for (auto& request : batch) {
+            auto& connection = *request.connection;
+            if (request.op == Op::Insert && connection.queried) {
+                ++connection.round;
+                connection.queried = false;
+            }
+            connection.queried |= request.op != Op::Insert;
+            request.round = connection.round;
+        }
+
+        std::vector<std::size_t> order(batch.size());
+        std::iota(order.begin(), order.end(), std::size_t{ 0 });
+        std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+            return batch[a].round < batch[b].round;
+        });
+        for (auto first = order.begin(); first != order.end();) {
+            auto round = batch[*first].round;
+            auto last = std::find_if(first, order.end(), [&](std::size_t i) { return batch[i].round != round; });
+            ProcessRound(std::span<const std::size_t>(first, last));
+            first = last;
+        }
+
+        // requests of one connection are in the batch in the order they were received
+        for (auto& request : batch) {
+            request.connection->out += request.response;
+            request.connection->out += '\n';
+            request.connection->round = 0;
+            request.connection->queried = false;
+        }
+        batch.clear();
+    }
+
+    // send as much of the pending output as the socket accepts
+    void Flush(Connection& connection) {
+        while (!connection.out.empty()) {
+            auto n = send(connection.fd, connection.out.data(), connection.out.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN) {
+                    connection.closed = true;
+                    return;
+                }
+                break;
+            }
+            connection.out.erase(0, static_cast<std::size_t>(n));
+        }
+
+        UpdateEvents(connection);
+    }
+
+    // poll for input until the peer shuts down unless too many responses are unsent,
+    // and for output only while there is something left to send
+    void UpdateEvents(Connection& connection) {
+        bool reading = !connection.readDone && connection.out.size() <= MAX_OUTPUT;
+        std::uint32_t events = (reading ? std::uint32_t{ EPOLLIN } : 0u)
+            | (connection.out.empty() ? 0u : std::uint32_t{ EPOLLOUT });
+        if (events != connection.events) {
+            connection.events = events;
+            Watch(connection, events, EPOLL_CTL_MOD);
+        }
+    }
+
+public:
+    ~RankServer() {
+        connections.clear();
+        if (listener.fd >= 0) {
+            close(listener.fd);
+        }
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+    }
+
+    // listen on a unix domain socket at path, or on 127.0.0.1 if path is a port number
+    bool Listen(const std::string& path) {
+        epollFd = epoll_create1(0);
+        if (epollFd < 0) {
+            return false;
+        }
+
+        bool tcp = !path.empty() && std::all_of(path.begin(), path.end(), [](char c) { return c >= '0' && c <= '9'; });
+        if (tcp) {
+            std::uint16_t port = 0;
+            auto [ptr, error] = std::from_chars(path.data(), path.data() + path.size(), port);
+            if (error != std::errc{} || ptr != path.data() + path.size() || port == 0) { // only 1 to 65535
+                errno = EINVAL;
+                return false;
+            }
+            listener.fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (listener.fd < 0) {
+                return false;
+            }
+            int reuse = 1;
+            setsockopt(listener.fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = htons(port);
+            if (bind(listener.fd, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0) {
+                return false;
+            }
+        }
+        else {
+            sockaddr_un address{};
+            if (path.size() >= sizeof address.sun_path) {
+                return false;
+            }
+            // only a socket left over by an earlier run is removed, never any other file
+            struct stat status;
+            if (lstat(path.c_str(), &status) == 0) {
+                if (!S_ISSOCK(status.st_mode)) {
+                    errno = EEXIST;
+                    return false;
+                }
+                unlink(path.c_str());
+            }
+            else if (errno != ENOENT) {
+                return false;
+            }
+            listener.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listener.fd < 0) {
+                return false;
+            }
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            if (bind(listener.fd, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0) {
+                return false;
+            }
+        }
+
+        if (listen(listener.fd, SOMAXCONN) != 0 || !SetNonBlocking(listener.fd) || !Watch(listener, EPOLLIN, EPOLL_CTL_ADD)) {
+            return false;
+        }
+        acceptTask = AcceptLoop();
+        return true;
+    }
+
+    void Run() {
+        epoll_event events[MAX_EVENTS];
+        for (;;) {
+            int n = epoll_wait(epollFd, events, MAX_EVENTS, acceptPaused ? ACCEPT_RETRY_MS : -1);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+
+            // resume readers, they only parse requests into the batch
+            for (int i = 0; i < n; ++i) {
+                auto channel = static_cast<Channel*>(events[i].data.ptr);
+                if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && channel->reader && !channel->reader.done()) {
+                    std::exchange(channel->reader, nullptr).resume();
+                }
+            }
+
+            ProcessBatch();
+
+            // send responses, including leftovers of connections waiting for EPOLLOUT
+            for (auto& connection : connections) {
+                if (!connection->closed && !connection->out.empty()) {
+                    Flush(*connection);
+                }
+            }
+
+            auto closedConnections = std::erase_if(connections, [](const std::unique_ptr<Connection>& connection) {
+                return connection->closed || (connection->readDone && connection->out.empty());
+            });
+            if (acceptPaused && (closedConnections > 0 || std::chrono::steady_clock::now() >= acceptRetry)) {
+                ResumeAccept();
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "/tmp/rbtree.sock";
+
+    RankServer server;
+    if (!server.Listen(path)) {
+        std::perror("rankServer");
+        return 1;
+    }
+    server.Run();
+    return 0;
+}
@@ -0,0 +1,99 @@
+// treeExport.cpp : writes an RBTree as SVG or Graphviz DOT (no platform dependencies)
+//
+// Build:  g++ -std=c++20 -O2 treeExport.cpp -o treeExport
+// Run:    treeExport svg|dot [options] < keys.txt > tree.svg
+//
+// Keys are read from stdin, one integer per whitespace, unless --random is given:
+//   --random <n>          insert n random keys in [0, n) instead
+//   --max-depth <d>       collapse subtrees below depth d
+//   --view <l> <t> <w> <h>   SVG only, visible part of the drawing in pixels
+//   --range <first> <last>   DOT only, in-order positions of the nodes to write
+// A DOT file keeps its layout when rendered with `neato -n -Tsvg tree.dot`.
+
+#include "orderStatisticRedBlackTree.h"
+#include "treeLayout.h"
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+int Usage() {
+    std::fprintf(stderr, "usage: treeExport svg|dot [--random n] [--max-depth d] [--view l t w h] [--range first last]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        return Usage();
+    }
+    std::string format = argv[1];
+    if (format != "svg" && format != "dot") {
+        return Usage();
+    }
+
+    SvgOptions svg;
+    DotOptions dot;
+    std::size_t randomKeys = 0;
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string option = argv[i];
+            auto remaining = argc - i - 1;
+            if (option == "--random" && remaining >= 1) {
+                randomKeys = std::stoul(argv[++i]);
+            }
+            else if (option == "--max-depth" && remaining >= 1) {
+                svg.maxDepth = dot.maxDepth = std::stoul(argv[++i]);
+            }
+            else if (option == "--view" && remaining >= 4) {
+                svg.viewLeft = std::stod(argv[++i]);
+                svg.viewTop = std::stod(argv[++i]);
+                svg.viewWidth = std::stod(argv[++i]);
+                svg.viewHeight = std::stod(argv[++i]);
+            }
+            else if (option == "--range" && remaining >= 2) {
+                dot.firstX = std::stoul(argv[++i]);
+                dot.lastX = std::stoul(argv[++i]);
+            }
+            else {
+                return Usage();
+            }
+        }
+    }
+    catch (const std::exception&) { // std::stoul and std::stod reject malformed numbers
+        return Usage();
+    }
+
+    RBTree<long long, NoStats, CountDuplicates> tree;
+    if (randomKeys > 0) {
+        std::mt19937_64 random(randomKeys);
+        for (std::size_t i = 0; i < randomKeys; ++i) {
+            tree.RBInsert(static_cast<long long>(random() % randomKeys));
+        }
+    }
+    else {
+        long long key;
+        while (std::cin >> key) {
+            tree.RBInsert(key);
+        }
+        if (!std::cin.eof()) {
+            std::fprintf(stderr, "treeExport: keys must be integers\n");
+            return 1;
+        }
+    }
+
+    TreeLayout<long long, CountDuplicates> layout;
+    layout.Update(tree);
+    if (format == "svg") {
+        ExportSvg(std::cout, layout, svg);
+    }
+    else {
+        ExportDot(std::cout, layout, dot);
+    }
+    return std::cout.good() ? 0 : 1;
+}
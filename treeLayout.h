@@ -0,0 +1,267 @@
+// treeLayout.h : platform neutral layout of RBTree together with SVG and DOT export
+//
+
+#pragma once
+
+#include "orderStatisticRedBlackTree.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// parent index of the root in the layout
+constexpr std::size_t NO_PARENT = (std::numeric_limits<std::size_t>::max)();
+
+// position of one node of the tree
+template<typename T, typename Duplicates = SeparateDuplicates>
+requires Comparable<T>
+struct LayoutNode {
+    const Node<T, Duplicates>* node; // node of the tree
+    std::size_t x; // in-order index of node, 0 for the leftmost node
+    std::size_t depth; // 0 for the root
+    std::size_t parent; // index of the parent in the layout, NO_PARENT for the root
+    std::size_t firstX; // smallest x in the subtree of node
+    std::size_t lastX; // largest x in the subtree of node
+    std::size_t subtreeEnd; // index just past the subtree of node, layout is stored in preorder
+};
+
+// in-order layout of a tree: x of a node is its position in sorted order and y is its depth,
+// so subtrees never overlap and each subtree covers a contiguous range of x.
+// The layout is cached and only rebuilt after the tree was modified.
+template<typename T, typename Duplicates = SeparateDuplicates>
+requires Comparable<T>
+class TreeLayout {
+
+    std::vector<LayoutNode<T, Duplicates>> nodes; // layout in preorder
+    std::size_t height = 0; // number of levels
+    const void* source = nullptr; // tree the layout was computed for
+    std::uint64_t version = 0; // version of the tree the layout was computed for
+
+    void LayoutHelper(const Node<T, Duplicates>* node, std::size_t depth, std::size_t parent, std::size_t& nextX) {
+        auto index = nodes.size();
+        nodes.push_back({ node, 0, depth, parent, nextX, 0, 0 });
+        height = (std::max)(height, depth + 1);
+
+        if (node->left != nullptr) {
+            LayoutHelper(node->left, depth + 1, index, nextX);
+        }
+        nodes[index].x = nextX++;
+        if (node->right != nullptr) {
+            LayoutHelper(node->right, depth + 1, index, nextX);
+        }
+        nodes[index].lastX = nextX - 1;
+        nodes[index].subtreeEnd = nodes.size();
+    }
+
+public:
+    // recompute the layout in O(n) if the tree changed since the last call
+    // returns true if the layout was recomputed
+    template<typename Stats>
+    bool Update(const RBTree<T, Stats, Duplicates>& tree) {
+        if (source == &tree && version == tree.Version()) {
+            return false;
+        }
+        source = &tree;
+        version = tree.Version();
+        nodes.clear(); // keeps the capacity for the next recomputation
+        height = 0;
+
+        std::size_t nextX = 0;
+        if (tree.GetRoot() != nullptr) {
+            LayoutHelper(tree.GetRoot(), 0, NO_PARENT, nextX);
+        }
+        return true;
+    }
+
+    const std::vector<LayoutNode<T, Duplicates>>& Nodes() const {
+        return nodes;
+    }
+
+    // number of distinct x positions
+    std::size_t Width() const {
+        return nodes.size();
+    }
+
+    std::size_t Height() const {
+        return height;
+    }
+};
+
+// options of ExportSvg, all lengths in pixels
+struct SvgOptions {
+    double nodeSpacing = 40; // horizontal distance of neighbouring nodes
+    double levelHeight = 80; // vertical distance of levels
+    double radius = 15; // radius of a node, shrunk if nodes would overlap
+    double minLabelRadius = 6; // keys of smaller nodes are not printed
+    std::size_t maxDepth = 64; // subtrees below this depth are drawn as a single box
+
+    // visible part of the drawing, nodes outside of it are culled
+    // viewWidth or viewHeight of 0 shows the whole tree
+    double viewLeft = 0;
+    double viewTop = 0;
+    double viewWidth = 0;
+    double viewHeight = 0;
+};
+
+// options of ExportDot
+struct DotOptions {
+    std::size_t maxDepth = 64; // subtrees below this depth are written as a single box
+
+    // in-order range of the layout to write, subtrees outside of it are culled
+    std::size_t firstX = 0;
+    std::size_t lastX = (std::numeric_limits<std::size_t>::max)();
+};
+
+namespace detail {
+
+// text of a node, key followed by its count if the key is stored more than once
+template<typename T, typename Duplicates>
+std::string LayoutLabel(const Node<T, Duplicates>* node) {
+    std::ostringstream label;
+    label << node->key;
+    if (CountOf(node) > 1) {
+        label << " x" << CountOf(node);
+    }
+    return label.str();
+}
+
+inline std::string EscapeXml(const std::string& text) {
+    std::string out;
+    for (auto c : text) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+inline std::string EscapeDot(const std::string& text) {
+    std::string out;
+    for (auto c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+} // namespace detail
+
+// write visible part of the layout as SVG.
+// Subtrees entirely outside of the viewport are skipped without visiting their nodes,
+// so the cost depends on the visible part of the tree and not on its size.
+template<typename T, typename Duplicates>
+requires Comparable<T>
+void ExportSvg(std::ostream& out, const TreeLayout<T, Duplicates>& layout, const SvgOptions& options = {}) {
+    const auto& nodes = layout.Nodes();
+    auto radius = (std::min)(options.radius, options.nodeSpacing * 0.45);
+    bool labels = radius >= options.minLabelRadius;
+    auto depthLimit = (std::min)(layout.Height(), options.maxDepth + 1);
+
+    auto left = options.viewLeft;
+    auto top = options.viewTop;
+    auto width = options.viewWidth > 0 ? options.viewWidth : layout.Width() * options.nodeSpacing;
+    auto height = options.viewHeight > 0 ? options.viewHeight : depthLimit * options.levelHeight;
+
+    auto px = [&](std::size_t x) { return (x + 0.5) * options.nodeSpacing; };
+    auto py = [&](std::size_t depth) { return (depth + 0.5) * options.levelHeight; };
+
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+        << "\" viewBox=\"" << left << ' ' << top << ' ' << width << ' ' << height << "\">\n";
+
+    // edges first so that nodes are drawn over them
+    for (int pass = 0; pass < 2; ++pass) {
+        out << (pass == 0 ? "<g stroke=\"black\">\n" : "<g font-family=\"Times New Roman\" text-anchor=\"middle\">\n");
+        std::size_t i = 0;
+        while (i < nodes.size()) {
+            const auto& n = nodes[i];
+            auto x = px(n.x);
+            auto y = py(n.depth);
+
+            // cull subtrees left or right of the viewport and below it
+            if (px(n.lastX) + radius < left || px(n.firstX) - radius > left + width || y - radius > top + height) {
+                i = n.subtreeEnd;
+                continue;
+            }
+
+            bool collapsed = n.depth == options.maxDepth && n.subtreeEnd > i + 1;
+            if (pass == 0) {
+                if (n.parent != NO_PARENT) {
+                    const auto& p = nodes[n.parent];
+                    out << "<line x1=\"" << px(p.x) << "\" y1=\"" << py(p.depth)
+                        << "\" x2=\"" << x << "\" y2=\"" << y << "\"/>\n";
+                }
+            }
+            else {
+                out << "<circle cx=\"" << x << "\" cy=\"" << y << "\" r=\"" << radius << "\" fill=\""
+                    << (n.node->color == ::Color::Red ? "red" : "black") << "\"/>\n";
+                if (labels) {
+                    out << "<text x=\"" << x << "\" y=\"" << y + radius * 0.35 << "\" font-size=\"" << radius
+                        << "\" fill=\"white\">" << detail::EscapeXml(detail::LayoutLabel(n.node)) << "</text>\n";
+                }
+                if (collapsed) { // level of detail, whole subtree below is a single box
+                    auto boxLeft = px(n.firstX) - radius;
+                    auto boxWidth = px(n.lastX) - px(n.firstX) + 2 * radius;
+                    out << "<rect x=\"" << boxLeft << "\" y=\"" << y + radius << "\" width=\"" << boxWidth
+                        << "\" height=\"" << options.levelHeight - radius << "\" fill=\"gray\"/>\n";
+                    if (labels) {
+                        out << "<text x=\"" << x << "\" y=\"" << y + options.levelHeight * 0.6 << "\" font-size=\""
+                            << radius << "\" fill=\"white\">" << n.node->size - CountOf(n.node) << " keys</text>\n";
+                    }
+                }
+            }
+            i = collapsed ? n.subtreeEnd : i + 1;
+        }
+        out << "</g>\n";
+    }
+    out << "</svg>\n";
+}
+
+// write visible part of the layout as Graphviz DOT, with node positions so that `neato -n` keeps the layout.
+// Only subtrees reaching into the in-order range [firstX, lastX] are written, the others are skipped
+// without visiting their nodes. Subtrees below maxDepth are replaced by a single box node with their size.
+template<typename T, typename Duplicates>
+requires Comparable<T>
+void ExportDot(std::ostream& out, const TreeLayout<T, Duplicates>& layout, const DotOptions& options = {}) {
+    const auto& nodes = layout.Nodes();
+
+    out << "digraph RBTree {\n";
+    out << "  node [shape=circle style=filled fontcolor=white];\n";
+    std::size_t i = 0;
+    while (i < nodes.size()) {
+        const auto& n = nodes[i];
+
+        // cull subtrees left or right of the range, their parents are still written
+        if (n.lastX < options.firstX || n.firstX > options.lastX) {
+            i = n.subtreeEnd;
+            continue;
+        }
+
+        out << "  n" << i << " [label=\"" << detail::EscapeDot(detail::LayoutLabel(n.node)) << "\" fillcolor="
+            << (n.node->color == ::Color::Red ? "red" : "black") << " pos=\"" << n.x * 72 << ','
+            << -static_cast<long long>(n.depth) * 72 << "!\"];\n";
+        if (n.parent != NO_PARENT) {
+            out << "  n" << n.parent << " -> n" << i << ";\n";
+        }
+
+        if (n.depth == options.maxDepth && n.subtreeEnd > i + 1) { // collapse the subtree below
+            out << "  c" << i << " [shape=box fillcolor=gray label=\"" << n.node->size - CountOf(n.node)
+                << " keys\"];\n";
+            out << "  n" << i << " -> c" << i << ";\n";
+            i = n.subtreeEnd;
+        }
+        else {
+            ++i;
+        }
+    }
+    out << "}\n";
+}